@@ -14,8 +14,13 @@ struct identity {
         return std::forward<U>(v);
     }
 };
-struct nud {
-    using token_t = token<double>;
+
+// T is the storage type of the input values, A is the accumulator type carried through the
+// evaluation (e.g. basic_nud<float, double> rounds every literal to float but evaluates in double,
+// and the result is rounded to float only when the caller stores it)
+template <typename T, typename A = T>
+struct basic_nud {
+    using token_t = token<A>;
     using value_t = typename token_t::value_t;
 
     template <typename Parser>
@@ -25,7 +30,7 @@ struct nud {
 
         switch (tok.kind()) {
         case token_kind::constant: {
-            return left.value();
+            return static_cast<T>(left.value());
         }
 
         case token_kind::dynamic: {
@@ -34,6 +39,27 @@ struct nud {
                 return -parser.parse_bp(bp, token_kind::eof).value();
             }
             case operations::exp: {
+                // fused exp(-x) and exp - x: fold the unary minus instead of dispatching it as a separate nud
+                auto is_minus = [](token_t const& t) { return t.kind() == token_kind::dynamic && t.opcode() == operations::sub; };
+                auto next = parser.lexer_.peek();
+                if (is_minus(next)) {
+                    parser.lexer_.consume();
+                    return std::exp(-parser.parse_bp(next.precedence(), token_kind::eof).value());
+                }
+                if (next.kind() == token_kind::lparen) {
+                    parser.lexer_.consume();
+                    token_t group;
+                    if (auto minus = parser.lexer_.peek(); is_minus(minus)) {
+                        parser.lexer_.consume();
+                        // the group may continue after -x, e.g. exp(-x + 1)
+                        auto x = parser.parse_bp(minus.precedence(), token_kind::eof).value();
+                        group = parser.parse_led(parser.expr(-x), 0, token_kind::rparen);
+                    } else {
+                        group = parser.parse_bp(0, token_kind::rparen);
+                    }
+                    parser.expect_rparen();
+                    return std::exp(parser.parse_led(group, bp, token_kind::eof).value());
+                }
                 return std::exp(parser.parse_bp(bp, token_kind::eof).value());
             }
             case operations::log: {
@@ -52,8 +78,8 @@ struct nud {
                 return std::sqrt(parser.parse_bp(bp, token_kind::eof).value());
             }
             case operations::square: {
-                 auto v = parser.parse_bp(bp, token_kind::eof).value();
-                 return v * v;
+                auto v = parser.parse_bp(bp, token_kind::eof).value();
+                return v * v;
             }
             default: {
                 throw std::runtime_error("led: unknown dynamic node opcode " + std::to_string(tok.opcode()));
@@ -74,8 +100,10 @@ struct nud {
     }
 };
 
-struct led {
-    using token_t = token<double>;
+// all arithmetic happens in A, T is only there so that nud and led are instantiated alike
+template <typename T, typename A = T>
+struct basic_led {
+    using token_t = token<A>;
     using value_t = typename token_t::value_t;
 
     template <typename Parser>
@@ -114,6 +142,69 @@ struct led {
     }
 };
 
+// opt-in fused operations: the parser passes the caller's binding power and end token, so a
+// product can absorb a following + or - that binds to it at this level (a * b + c -> fma(a, b, c)).
+// square(a + b) and c * exp(x) are not fused: they already take one multiply after the sum or
+// the exponential, and there is no fused primitive that would save work or a rounding.
+template <typename T, typename A = T>
+struct basic_fused_led : basic_led<T, A> {
+    using token_t = typename basic_led<T, A>::token_t;
+    using value_t = typename basic_led<T, A>::value_t;
+
+    using basic_led<T, A>::operator();
+
+    template <typename Parser>
+    auto operator()(Parser& parser, token_t const& tok, token_t const& left, token_t const& right, int rbp, token_kind end) -> value_t
+    {
+        if (tok.kind() == token_kind::dynamic && tok.opcode() == operations::mul) {
+            auto next = parser.lexer_.peek();
+            if (next.kind() == token_kind::dynamic && next.precedence() > rbp
+                && (next.opcode() == operations::add || next.opcode() == operations::sub)) {
+                parser.lexer_.consume();
+
+                // same binding power the parser would use for the right operand of next
+                int bp{0};
+                if (next.is_left_associative()) {
+                    bp = next.precedence();
+                } else if (next.is_right_associative()) {
+                    bp = next.precedence() - 1;
+                }
+
+                auto c = parser.parse_bp(bp, end).value();
+                return std::fma(left.value(), right.value(), next.opcode() == operations::add ? c : -c);
+            }
+        }
+        return (*this)(parser, tok, left, right);
+    }
+};
+
+using nud = basic_nud<double>;
+using led = basic_led<double>;
+using fused_led = basic_fused_led<double>;
+
+// the calculator token map. the parser and lexer keep a reference to it, so store it in a named variable.
+template <typename Token = nud::token_t>
+auto make_tokens() -> std::unordered_map<std::string_view, Token>
+{
+    return {
+        { "+", Token(token_kind::dynamic, "+", operations::add, 10, associativity::left) },
+        { "-", Token(token_kind::dynamic, "-", operations::sub, 10, associativity::left) },
+        { "*", Token(token_kind::dynamic, "*", operations::mul, 20, associativity::left) },
+        { "/", Token(token_kind::dynamic, "/", operations::div, 20, associativity::left) },
+        { "^", Token(token_kind::dynamic, "^", operations::pow, 30, associativity::right) },
+        { "exp", Token(token_kind::dynamic, "exp", operations::exp, 30, associativity::none) },
+        { "log", Token(token_kind::dynamic, "log", operations::log, 30, associativity::none) },
+        { "sin", Token(token_kind::dynamic, "sin", operations::sin, 30, associativity::none) },
+        { "cos", Token(token_kind::dynamic, "cos", operations::cos, 30, associativity::none) },
+        { "tan", Token(token_kind::dynamic, "tan", operations::tan, 30, associativity::none) },
+        { "sqrt", Token(token_kind::dynamic, "sqrt", operations::sqrt, 30, associativity::none) },
+        { "square", Token(token_kind::dynamic, "square", operations::square, 30, associativity::right) },
+        { "(", Token(token_kind::lparen, "(", operations::noop, 0, associativity::none) },
+        { ")", Token(token_kind::rparen, "(", operations::noop, 0, associativity::none) },
+        { "eof", Token(token_kind::eof, "eof", operations::noop, 0, associativity::none) }
+    };
+}
+
 } // namespace pratt::calculator
 
 #endif
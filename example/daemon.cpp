@@ -0,0 +1,308 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <deque>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "calculator.hpp"
+#include "daemon.hpp"
+#include "sexpr.hpp"
+
+// serves parse/evaluate requests over a unix domain socket (see daemon.hpp for the framing)
+//
+// requests from all connections are coalesced into batches of up to [batch] requests,
+// optionally waiting up to [delay] microseconds for a batch to fill (0 by default), and the
+// batches are evaluated by a pool of [threads] workers sharing the same immutable token maps.
+// the responses of a batch are sent with one write per connection.
+//
+// usage: daemon [socket] [threads] [batch] [delay]
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+struct connection {
+    explicit connection(int fd)
+        : fd(fd)
+    {
+    }
+    connection(connection const&) = delete;
+    connection(connection&&) = delete;
+    auto operator=(connection const&) -> connection& = delete;
+    auto operator=(connection&&) -> connection& = delete;
+    ~connection() { ::close(fd); }
+
+    int fd;
+    std::mutex write_mutex;
+};
+
+struct request {
+    std::shared_ptr<connection> conn;
+    pratt::daemon::frame frame;
+    clock_type::time_point received;
+};
+
+// the responses of a batch for one connection, sent with a single write
+struct reply {
+    std::shared_ptr<connection> conn;
+    std::string buf;
+    std::vector<clock_type::time_point> received;
+};
+
+struct reader {
+    std::weak_ptr<connection> conn;
+    std::thread thread;
+    std::atomic<bool> done { false };
+};
+
+class batch_queue {
+public:
+    void push(request r)
+    {
+        {
+            std::lock_guard lock(mutex_);
+            if (stopped_) {
+                return;
+            }
+            queue_.push_back(std::move(r));
+        }
+        cv_.notify_one();
+    }
+
+    // blocks until at least one request is available, then waits up to delay for the batch to fill
+    auto pop(std::vector<request>& batch, size_t size, std::chrono::microseconds delay) -> bool
+    {
+        std::unique_lock lock(mutex_);
+        cv_.wait(lock, [&] { return stopped_ || !queue_.empty(); });
+        if (queue_.size() < size && delay.count() > 0) {
+            cv_.wait_until(lock, clock_type::now() + delay, [&] { return stopped_ || queue_.size() >= size; });
+        }
+        if (queue_.empty()) {
+            return !stopped_;
+        }
+        auto n = std::min(size, queue_.size());
+        batch.assign(std::make_move_iterator(queue_.begin()), std::make_move_iterator(queue_.begin() + static_cast<std::ptrdiff_t>(n)));
+        queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(n));
+        return true;
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard lock(mutex_);
+            stopped_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<request> queue_;
+    bool stopped_ { false };
+};
+
+volatile std::sig_atomic_t interrupted { 0 };
+
+void on_signal(int /*unused*/) { interrupted = 1; }
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    using calc_nud = pratt::calculator::nud;
+    using calc_led = pratt::calculator::led;
+    using calc_conv = pratt::calculator::identity;
+
+    using sexpr_nud = pratt::sexpr::nud;
+    using sexpr_led = pratt::sexpr::led;
+    using sexpr_conv = pratt::sexpr::conv;
+
+    using pratt::daemon::frame;
+    using pratt::daemon::op;
+    using pratt::daemon::status;
+
+    auto const calc_tokens = pratt::calculator::make_tokens();
+    auto const sexpr_tokens = pratt::sexpr::make_tokens();
+
+    std::string path = argc > 1 ? argv[1] : "/tmp/pratt-parser.sock";
+    size_t threads = argc > 2 ? std::stoul(argv[2]) : std::max(1U, std::thread::hardware_concurrency());
+    size_t batch_size = argc > 3 ? std::stoul(argv[3]) : 64; // NOLINT
+    std::chrono::microseconds delay(argc > 4 ? std::stol(argv[4]) : 0);
+
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "socket path too long: " << path << "\n";
+        return 1;
+    }
+    std::copy(path.begin(), path.end(), addr.sun_path);
+
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        std::cerr << "cannot create socket: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    // replace a stale socket left by a previous run, but never anything else
+    struct stat st {};
+    if (::lstat(path.c_str(), &st) == 0) {
+        if (!S_ISSOCK(st.st_mode)) {
+            std::cerr << path << " exists and is not a socket\n";
+            return 1;
+        }
+        ::unlink(path.c_str());
+    }
+
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 // NOLINT
+        || ::listen(listener, SOMAXCONN) < 0) {
+        std::cerr << "cannot listen on " << path << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    // no SA_RESTART, so that accept is interrupted by the signal
+    struct sigaction sa {};
+    sa.sa_handler = on_signal;
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+
+    batch_queue queue;
+    pratt::daemon::histogram latency;
+    pratt::daemon::histogram batches;
+
+    auto handle = [&](frame const& req) -> frame {
+        frame res { req.id, static_cast<uint8_t>(status::ok), {} };
+        try {
+            switch (static_cast<op>(req.code)) {
+            case op::evaluate: {
+                auto value = pratt::parser<calc_nud, calc_led, calc_conv, decltype(calc_tokens)>(req.payload, calc_tokens, {}).parse();
+                res.payload.assign(reinterpret_cast<char const*>(&value), sizeof(value)); // NOLINT
+                break;
+            }
+            case op::parse: {
+                res.payload = pratt::parser<sexpr_nud, sexpr_led, sexpr_conv, decltype(sexpr_tokens)>(req.payload, sexpr_tokens, {}).parse();
+                break;
+            }
+            case op::stats: {
+                std::ostringstream buf;
+                buf << "latency (us)\n" << latency << "batch size\n" << batches;
+                res.payload = buf.str();
+                break;
+            }
+            default: {
+                throw std::runtime_error("unknown op " + std::to_string(req.code));
+            }
+            }
+        } catch (std::exception& e) {
+            res.code = static_cast<uint8_t>(status::error);
+            res.payload = e.what();
+        }
+        return res;
+    };
+
+    std::vector<std::thread> workers;
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([&]() {
+            std::vector<request> batch;
+            std::vector<reply> replies;
+            while (queue.pop(batch, batch_size, delay)) {
+                if (batch.empty()) {
+                    continue; // drained by another worker while waiting for the batch to fill
+                }
+                batches.record(batch.size());
+
+                // a batch holds requests from few connections, so a linear search is enough
+                for (auto& r : batch) {
+                    auto it = std::find_if(replies.begin(), replies.end(), [&](auto const& p) { return p.conn == r.conn; });
+                    if (it == replies.end()) {
+                        it = replies.insert(replies.end(), { r.conn, {}, {} });
+                    }
+                    pratt::daemon::append_frame(it->buf, handle(r.frame));
+                    it->received.push_back(r.received);
+                }
+
+                for (auto& p : replies) {
+                    {
+                        std::lock_guard lock(p.conn->write_mutex);
+                        pratt::daemon::write_all(p.conn->fd, p.buf.data(), p.buf.size());
+                    }
+                    auto now = clock_type::now();
+                    for (auto t : p.received) {
+                        latency.record(static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(now - t).count()));
+                    }
+                }
+                replies.clear();
+                batch.clear();
+            }
+        });
+    }
+
+    std::cout << "listening on " << path << " with " << threads << " threads, batch size " << batch_size << ", delay " << delay.count() << "us" << std::endl;
+
+    // reader threads are kept joinable, finished ones are reaped on every accept
+    std::list<reader> readers;
+    auto reap = [&readers]() {
+        for (auto it = readers.begin(); it != readers.end();) {
+            if (it->done) {
+                it->thread.join();
+                it = readers.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    };
+
+    while (interrupted == 0) {
+        int fd = ::accept(listener, nullptr, nullptr);
+        reap();
+        if (fd < 0) {
+            continue;
+        }
+        auto conn = std::make_shared<connection>(fd);
+        auto& r = readers.emplace_back();
+        r.conn = conn;
+        r.thread = std::thread([conn, &queue, &done = r.done]() mutable {
+            frame f;
+            while (pratt::daemon::read_frame(conn->fd, f)) {
+                queue.push({ conn, std::move(f), clock_type::now() });
+                f = frame {};
+            }
+            conn.reset();
+            done = true;
+        });
+    }
+
+    // unblock the readers still waiting on live clients, then drain the queue
+    for (auto& r : readers) {
+        if (auto conn = r.conn.lock()) {
+            ::shutdown(conn->fd, SHUT_RDWR);
+        }
+    }
+    for (auto& r : readers) {
+        r.thread.join();
+    }
+    queue.stop();
+    for (auto& w : workers) {
+        w.join();
+    }
+    ::close(listener);
+    ::unlink(path.c_str());
+
+    std::cout << "latency (us)\n" << latency << "batch size\n" << batches;
+    return 0;
+}
@@ -0,0 +1,168 @@
+#ifndef PRATT_DAEMON_HPP
+#define PRATT_DAEMON_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+// binary framing shared by the evaluation daemon and the load generator
+//
+// request:  u32 size | u32 id | u8 op     | payload (size - 5 bytes)
+// response: u32 size | u32 id | u8 status | payload (size - 5 bytes)
+//
+// integers are in host byte order since both ends live on the same machine.
+// the payload of a request is the infix expression, the payload of a response
+// is a double for op::evaluate, a string for op::parse and op::stats, or an
+// error message when status is status::error.
+
+namespace pratt::daemon {
+
+enum class op : uint8_t {
+    evaluate, // evaluate the expression with the calculator grammar
+    parse,    // convert the expression to an s-expression
+    stats     // return the latency and batch size histograms as text
+};
+
+enum class status : uint8_t {
+    ok,
+    error
+};
+
+struct frame {
+    uint32_t id { 0 };
+    uint8_t code { 0 }; // op for requests, status for responses
+    std::string payload;
+};
+
+constexpr size_t header_size = sizeof(uint32_t) + sizeof(uint32_t) + sizeof(uint8_t);
+constexpr size_t max_frame_size = 1U << 24U;
+
+inline auto read_all(int fd, char* buf, size_t len) -> bool
+{
+    while (len > 0) {
+        auto n = ::read(fd, buf, len);
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+inline auto write_all(int fd, char const* buf, size_t len) -> bool
+{
+    while (len > 0) {
+        auto n = ::send(fd, buf, len, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        len -= static_cast<size_t>(n);
+    }
+    return true;
+}
+
+inline auto read_frame(int fd, frame& f) -> bool
+{
+    std::array<char, header_size> header {};
+    if (!read_all(fd, header.data(), header.size())) {
+        return false;
+    }
+    uint32_t size { 0 };
+    std::memcpy(&size, header.data(), sizeof(size));
+    std::memcpy(&f.id, header.data() + sizeof(size), sizeof(f.id));
+    std::memcpy(&f.code, header.data() + sizeof(size) + sizeof(f.id), sizeof(f.code));
+    if (size < header_size || size > max_frame_size) {
+        return false;
+    }
+    f.payload.resize(size - header_size);
+    return read_all(fd, f.payload.data(), f.payload.size());
+}
+
+// appends the encoded frame to buf, so that several frames can be sent with a single write
+inline void append_frame(std::string& buf, frame const& f)
+{
+    auto offset = buf.size();
+    auto size = static_cast<uint32_t>(header_size + f.payload.size());
+    buf.resize(offset + size);
+    auto* p = buf.data() + offset;
+    std::memcpy(p, &size, sizeof(size));
+    std::memcpy(p + sizeof(size), &f.id, sizeof(f.id));
+    std::memcpy(p + sizeof(size) + sizeof(f.id), &f.code, sizeof(f.code));
+    std::memcpy(p + header_size, f.payload.data(), f.payload.size());
+}
+
+inline auto write_frame(int fd, frame const& f) -> bool
+{
+    std::string buf;
+    append_frame(buf, f);
+    return write_all(fd, buf.data(), buf.size());
+}
+
+// lock-free histogram with power of two buckets (used for latencies in microseconds and batch sizes)
+class histogram {
+public:
+    static constexpr size_t bucket_count = 32;
+
+    void record(uint64_t value)
+    {
+        size_t b { 0 };
+        while (b + 1 < bucket_count && (1ULL << b) <= value) {
+            ++b;
+        }
+        buckets_[b].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    [[nodiscard]] auto count() const -> uint64_t
+    {
+        uint64_t n { 0 };
+        for (auto const& b : buckets_) {
+            n += b.load(std::memory_order_relaxed);
+        }
+        return n;
+    }
+
+    // upper bound of the bucket containing the q-quantile
+    [[nodiscard]] auto quantile(double q) const -> uint64_t
+    {
+        auto n = count();
+        if (n == 0) {
+            return 0;
+        }
+        auto target = std::min(static_cast<uint64_t>(q * static_cast<double>(n)), n - 1);
+        uint64_t sum { 0 };
+        for (size_t b = 0; b < bucket_count; ++b) {
+            sum += buckets_[b].load(std::memory_order_relaxed);
+            if (sum > target) {
+                return 1ULL << b;
+            }
+        }
+        return 1ULL << (bucket_count - 1);
+    }
+
+    friend auto operator<<(std::ostream& os, histogram const& h) -> std::ostream&
+    {
+        os << "count " << h.count() << ", p50 < " << h.quantile(0.5) << ", p99 < " << h.quantile(0.99) << "\n"; // NOLINT
+        for (size_t b = 0; b < bucket_count; ++b) {
+            if (auto n = h.buckets_[b].load(std::memory_order_relaxed); n > 0) {
+                os << "  < " << (1ULL << b) << ": " << n << "\n";
+            }
+        }
+        return os;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, bucket_count> buckets_ {};
+};
+
+} // namespace pratt::daemon
+
+#endif
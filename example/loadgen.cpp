@@ -0,0 +1,132 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "daemon.hpp"
+
+// load generator for the evaluation daemon
+//
+// opens [connections] connections, each sending [requests] evaluate requests
+// in rounds of [depth] pipelined requests, then reports client side latency
+// percentiles, throughput and the daemon's own statistics.
+//
+// usage: loadgen [socket] [connections] [requests] [depth]
+
+namespace {
+
+using clock_type = std::chrono::steady_clock;
+
+auto connect(std::string const& path) -> int
+{
+    sockaddr_un addr {};
+    addr.sun_family = AF_UNIX;
+    std::copy_n(path.begin(), std::min(path.size(), sizeof(addr.sun_path) - 1), addr.sun_path);
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) { // NOLINT
+        throw std::runtime_error("cannot connect to " + path + ": " + std::strerror(errno));
+    }
+    return fd;
+}
+
+auto percentile(std::vector<double> const& sorted, double q) -> double
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    auto i = static_cast<size_t>(q * static_cast<double>(sorted.size() - 1));
+    return sorted[i];
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    using pratt::daemon::frame;
+    using pratt::daemon::op;
+    using pratt::daemon::status;
+
+    std::string path = argc > 1 ? argv[1] : "/tmp/pratt-parser.sock";
+    size_t connections = argc > 2 ? std::stoul(argv[2]) : 4; // NOLINT
+    size_t requests = argc > 3 ? std::stoul(argv[3]) : 10000; // NOLINT
+    size_t depth = argc > 4 ? std::stoul(argv[4]) : 8; // NOLINT
+
+    std::vector<std::string> const corpus {
+        "1 + 2 * 3",
+        "(1 + 2) * (3 + 4)",
+        "2 ^ 3 ^ 2",
+        "exp(tan(5))",
+        "square(exp(tan(5)))",
+        "cos(5) * sin(6)",
+        "0.5 + 1.5 * 2.25 - 3.125 / 4",
+        "exp - 2 * 3 + 1"
+    };
+
+    std::vector<std::vector<double>> latencies(connections);
+    std::vector<size_t> errors(connections);
+
+    auto start = clock_type::now();
+    std::vector<std::thread> clients;
+    for (size_t c = 0; c < connections; ++c) {
+        clients.emplace_back([&, c]() {
+            int fd = connect(path);
+            std::vector<clock_type::time_point> sent(depth);
+            auto& lat = latencies[c];
+            lat.reserve(requests);
+
+            for (size_t i = 0; i < requests; i += depth) {
+                auto n = std::min(depth, requests - i);
+                for (size_t j = 0; j < n; ++j) {
+                    frame req { static_cast<uint32_t>(j), static_cast<uint8_t>(op::evaluate), corpus[(i + j) % corpus.size()] };
+                    sent[j] = clock_type::now();
+                    pratt::daemon::write_frame(fd, req);
+                }
+                for (size_t j = 0; j < n; ++j) {
+                    frame res;
+                    if (!pratt::daemon::read_frame(fd, res)) {
+                        throw std::runtime_error("connection closed by daemon");
+                    }
+                    lat.push_back(std::chrono::duration<double, std::micro>(clock_type::now() - sent[res.id]).count());
+                    errors[c] += res.code != static_cast<uint8_t>(status::ok);
+                }
+            }
+            ::close(fd);
+        });
+    }
+    for (auto& t : clients) {
+        t.join();
+    }
+    auto seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    std::vector<double> all;
+    for (auto const& lat : latencies) {
+        all.insert(all.end(), lat.begin(), lat.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    size_t failed { 0 };
+    for (auto e : errors) {
+        failed += e;
+    }
+
+    std::cout << all.size() << " requests (" << failed << " errors) in " << seconds << "s, " << static_cast<double>(all.size()) / seconds << " req/s\n";
+    std::cout << "latency p50 " << percentile(all, 0.5) << "us, p99 " << percentile(all, 0.99) << "us, max " << (all.empty() ? 0 : all.back()) << "us\n"; // NOLINT
+
+    int fd = connect(path);
+    frame stats;
+    if (pratt::daemon::write_frame(fd, { 0, static_cast<uint8_t>(op::stats), {} }) && pratt::daemon::read_frame(fd, stats)) {
+        std::cout << "daemon " << stats.payload;
+    }
+    ::close(fd);
+    return 0;
+}
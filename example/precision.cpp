@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "calculator.hpp"
+
+// compares the float and mixed precision (float storage, double accumulator)
+// calculator against the double calculator on randomly generated expressions
+//
+// the error of a result is |result - ref| / max(|ref|, 1), relative to the double reference.
+//
+// usage: precision [count] [repetitions]
+
+namespace {
+
+// random infix expression with bounded depth, using operations that stay finite for constants in [0.5, 2]
+auto generate(std::mt19937& rng, int depth) -> std::string
+{
+    std::uniform_real_distribution<double> value(0.5, 2.0);
+    std::uniform_int_distribution<int> choice(0, 6);
+
+    if (depth == 0) {
+        std::ostringstream buf;
+        buf << std::setprecision(std::numeric_limits<double>::max_digits10) << value(rng);
+        return buf.str();
+    }
+
+    auto lhs = generate(rng, depth - 1);
+    switch (choice(rng)) {
+    case 0:
+        return "( " + lhs + " + " + generate(rng, depth - 1) + " )";
+    case 1:
+        return "( " + lhs + " - " + generate(rng, depth - 1) + " )";
+    case 2:
+        return "( " + lhs + " * " + generate(rng, depth - 1) + " )";
+    case 3:
+        return "( " + lhs + " / " + generate(rng, depth - 1) + " )";
+    case 4:
+        return "sin ( " + lhs + " )";
+    case 5:
+        return "cos ( " + lhs + " )";
+    default:
+        return "sqrt ( square ( " + lhs + " ) )";
+    }
+}
+
+// T is the storage type (of the literals and the result), A the accumulator type
+template <typename T, typename A>
+auto evaluate(std::vector<std::string> const& inputs, std::vector<double>& results, int repetitions) -> double
+{
+    using nud = pratt::calculator::basic_nud<T, A>;
+    using led = pratt::calculator::basic_led<T, A>;
+    auto const tokens = pratt::calculator::make_tokens<typename nud::token_t>();
+
+    results.resize(inputs.size());
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < repetitions; ++r) {
+        for (size_t i = 0; i < inputs.size(); ++i) {
+            pratt::parser<nud, led, pratt::calculator::identity, decltype(tokens)> p(inputs[i], tokens, {});
+            results[i] = static_cast<T>(p.parse());
+        }
+    }
+    auto end = std::chrono::steady_clock::now();
+    auto seconds = std::chrono::duration<double>(end - start).count();
+    return static_cast<double>(inputs.size()) * repetitions / seconds;
+}
+
+void report(std::string const& name, std::vector<double> const& reference, std::vector<double> const& results, double throughput)
+{
+    double max_err { 0 };
+    double sum_err { 0 };
+    for (size_t i = 0; i < reference.size(); ++i) {
+        // relative error for |ref| >= 1, absolute error below, so that results near zero
+        // (from cancellation in a - b) do not dominate the report
+        auto err = std::abs(results[i] - reference[i]) / std::max(std::abs(reference[i]), 1.0);
+        max_err = std::max(max_err, err);
+        sum_err += err;
+    }
+    std::cout << std::left << std::setw(8) << name
+              << std::right << std::setw(16) << throughput
+              << std::setw(16) << max_err
+              << std::setw(16) << sum_err / static_cast<double>(reference.size()) << "\n";
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    size_t count = argc > 1 ? std::stoul(argv[1]) : 10000;
+    int repetitions = argc > 2 ? std::stoi(argv[2]) : 10;
+
+    std::mt19937 rng(1234); // NOLINT
+    std::vector<std::string> inputs(count);
+    for (auto& s : inputs) {
+        s = generate(rng, 4);
+    }
+
+    std::vector<double> reference;
+    std::vector<double> results;
+
+    std::cout << std::left << std::setw(8) << "type"
+              << std::right << std::setw(16) << "expr/s"
+              << std::setw(16) << "max err"
+              << std::setw(16) << "mean err" << "\n";
+
+    auto t = evaluate<double, double>(inputs, reference, repetitions);
+    report("double", reference, reference, t);
+
+    t = evaluate<float, float>(inputs, results, repetitions);
+    report("float", reference, results, t);
+
+    t = evaluate<float, double>(inputs, results, repetitions);
+    report("mixed", reference, results, t);
+
+    return 0;
+}
@@ -21,7 +21,9 @@ enum operations { add,
     square,
     noop };
 
-struct nud {
+// with Groups set, parenthesized subexpressions are kept as (group ...) nodes
+template <bool Groups = false>
+struct basic_nud {
     using token_t = token<std::string>;
     using value_t = typename token_t::value_t;
 
@@ -48,6 +50,7 @@ struct nud {
             case operations::cos:
             case operations::tan:
             case operations::sqrt:
+            case operations::square:
                 return "(" + tok.name() + " " + parser.parse_bp(bp, token_kind::eof).value() + ")";
             default: {
                 throw std::runtime_error("led: unknown dynamic node opcode " + std::to_string(tok.opcode()));
@@ -57,7 +60,11 @@ struct nud {
         }
 
         case token_kind::lparen: {
-            return parser.parse_bp(bp, token_kind::rparen).value();
+            if constexpr (Groups) {
+                return "(group " + parser.parse_bp(bp, token_kind::rparen).value() + ")";
+            } else {
+                return parser.parse_bp(bp, token_kind::rparen).value();
+            }
         }
 
         default: {
@@ -68,6 +75,8 @@ struct nud {
     }
 };
 
+using nud = basic_nud<>;
+
 struct led {
     using token_t = token<std::string>;
     using value_t = token_t::value_t;
@@ -105,6 +114,29 @@ struct conv {
     }
 };
 
+// the s-expression token map. the parser and lexer keep a reference to it, so store it in a named variable.
+inline auto make_tokens() -> std::unordered_map<std::string_view, nud::token_t>
+{
+    using Token = nud::token_t;
+    return {
+        { "+", Token(token_kind::dynamic, "+", operations::add, 10, associativity::left) },
+        { "-", Token(token_kind::dynamic, "-", operations::sub, 10, associativity::left) },
+        { "*", Token(token_kind::dynamic, "*", operations::mul, 20, associativity::left) },
+        { "/", Token(token_kind::dynamic, "/", operations::div, 20, associativity::left) },
+        { "^", Token(token_kind::dynamic, "^", operations::pow, 30, associativity::right) },
+        { "exp", Token(token_kind::dynamic, "exp", operations::exp, 30, associativity::none) },
+        { "log", Token(token_kind::dynamic, "log", operations::log, 30, associativity::none) },
+        { "sin", Token(token_kind::dynamic, "sin", operations::sin, 30, associativity::none) },
+        { "cos", Token(token_kind::dynamic, "cos", operations::cos, 30, associativity::none) },
+        { "tan", Token(token_kind::dynamic, "tan", operations::tan, 30, associativity::none) },
+        { "sqrt", Token(token_kind::dynamic, "sqrt", operations::sqrt, 30, associativity::none) },
+        { "square", Token(token_kind::dynamic, "square", operations::square, 30, associativity::none) },
+        { "(", Token(token_kind::lparen, "(", operations::noop, 0, associativity::none) },
+        { ")", Token(token_kind::rparen, "(", operations::noop, 0, associativity::none) },
+        { "eof", Token(token_kind::eof, "eof", operations::noop, 0, associativity::none) }
+    };
+}
+
 } // namespace pratt::sexpr
 
 #endif
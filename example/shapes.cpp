@@ -0,0 +1,152 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "sexpr.hpp"
+
+// mines a corpus of infix expressions (one per line on stdin) for the most
+// frequent subtree shapes, to help decide which operations are worth fusing
+//
+// usage: shapes [depth] [count]
+//   depth - maximum number of operator levels in a shape (default 2)
+//   count - number of shapes to print (default 20)
+//
+// shapes already fused by the calculator (pratt::calculator::fused_led and the exp nud) are marked.
+// parentheses limit what can be fused (fused_led does not fuse (a * b) + c), so parenthesized
+// subexpressions appear as group nodes, which do not count as an operator level.
+
+namespace {
+
+// constants and variables are both abstracted away as a leaf
+struct conv {
+    auto operator()(double /*unused*/) const noexcept -> std::string { return "_"; }
+};
+
+// (+ (* _ _) _) and (- (* _ _) _) need the left-hand product, i.e. a * b + c, not c + a * b
+std::set<std::string> const fused {
+    "(+ (* _ _) _)",
+    "(- (* _ _) _)",
+    "(exp (- _))",
+    "(exp (group (- _)))"
+};
+
+struct node {
+    std::string name;
+    std::vector<node> children;
+};
+
+auto is_group(node const& n) -> bool { return n.name == "group"; }
+
+// reads an s-expression as produced by pratt::sexpr
+auto read(std::string const& s, size_t& i) -> node
+{
+    while (i < s.size() && std::isspace(s[i])) {
+        ++i;
+    }
+
+    node n;
+    if (s[i] != pratt::lp) {
+        auto j = i;
+        while (j < s.size() && !(std::isspace(s[j]) || pratt::is<pratt::lp, pratt::rp>(s[j]))) {
+            ++j;
+        }
+        n.name = "_";
+        i = j;
+        return n;
+    }
+
+    ++i; // eat lparen
+    auto j = i;
+    while (j < s.size() && !std::isspace(s[j])) {
+        ++j;
+    }
+    n.name = s.substr(i, j - i);
+    i = j;
+
+    while (true) {
+        while (i < s.size() && std::isspace(s[i])) {
+            ++i;
+        }
+        if (i >= s.size() || s[i] == pratt::rp) {
+            break;
+        }
+        n.children.push_back(read(s, i));
+    }
+    ++i; // eat rparen
+    return n;
+}
+
+// prints the shape of the subtree rooted at n, cut off after depth operator levels
+auto shape(node const& n, int depth) -> std::string
+{
+    if (n.children.empty() || depth == 0) {
+        return "_";
+    }
+    auto d = is_group(n) ? depth : depth - 1;
+    std::string s = "(" + n.name;
+    for (auto const& c : n.children) {
+        s += " " + shape(c, d);
+    }
+    return s + ")";
+}
+
+void collect(node const& n, int depth, std::map<std::string, size_t>& counts)
+{
+    if (n.children.empty()) {
+        return;
+    }
+    // a group on its own is the shape of its content. shallow subtrees have the same
+    // shape at several depths, which is counted once.
+    std::set<std::string> shapes;
+    for (int d = 1; d <= depth && !is_group(n); ++d) {
+        shapes.insert(shape(n, d));
+    }
+    for (auto const& s : shapes) {
+        ++counts[s];
+    }
+    for (auto const& c : n.children) {
+        collect(c, depth, counts);
+    }
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    using nud = pratt::sexpr::basic_nud<true>;
+    using led = pratt::sexpr::led;
+
+    auto const tokens = pratt::sexpr::make_tokens();
+
+    int depth = argc > 1 ? std::stoi(argv[1]) : 2;
+    size_t count = argc > 2 ? std::stoul(argv[2]) : 20;
+
+    std::map<std::string, size_t> counts;
+    size_t lines { 0 };
+
+    std::string input;
+    while (std::getline(std::cin, input)) {
+        try {
+            pratt::parser<nud, led, conv> p(input, tokens, {});
+            auto sexpr = p.parse();
+            size_t i { 0 };
+            collect(read(sexpr, i), depth, counts);
+            ++lines;
+        } catch (std::exception& e) {
+            std::cerr << "error parsing input string: " << e.what() << "\n";
+        }
+    }
+
+    std::vector<std::pair<std::string, size_t>> shapes(counts.begin(), counts.end());
+    std::stable_sort(shapes.begin(), shapes.end(), [](auto const& a, auto const& b) { return a.second > b.second; });
+    shapes.resize(std::min(shapes.size(), count));
+
+    std::cout << lines << " expressions\n";
+    for (auto const& [s, n] : shapes) {
+        std::cout << n << "\t" << s << (fused.count(s) != 0 ? "\tfused" : "") << "\n";
+    }
+    return 0;
+}
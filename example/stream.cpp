@@ -0,0 +1,108 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "calculator.hpp"
+#include "pratt-parser/stream_lexer.hpp"
+
+// compares the whole-string lexer with the chunked stream lexer on a (large) expression read from stdin
+//
+// usage: stream generate [terms] > expr.txt   writes a flat expression with the given number of terms
+//        stream string < expr.txt             reads stdin into a string and evaluates it
+//        stream chunked [chunk] < expr.txt    evaluates stdin in chunks of [chunk] bytes
+//
+// each mode reports the evaluation time, throughput and peak RSS of the process,
+// so run the modes in separate processes when comparing memory use. the time of the
+// string mode excludes reading stdin, while the chunked mode reads as it evaluates.
+
+namespace {
+
+// peak resident set size in MB
+auto peak_rss() -> double
+{
+    rusage usage {};
+    ::getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<double>(usage.ru_maxrss) / (1024 * 1024); // bytes
+#else
+    return static_cast<double>(usage.ru_maxrss) / 1024; // kilobytes
+#endif
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int
+{
+    using nud = pratt::calculator::nud;
+    using led = pratt::calculator::led;
+    using conv = pratt::calculator::identity;
+    using token = nud::token_t;
+
+    auto const tokens = pratt::calculator::make_tokens();
+
+    std::string mode = argc > 1 ? argv[1] : "chunked";
+
+    if (mode == "generate") {
+        size_t terms = argc > 2 ? std::stoul(argv[2]) : 1000000; // NOLINT
+        std::cout << "1.5";
+        for (size_t i = 1; i < terms; ++i) {
+            switch (i % 4) { // NOLINT
+            case 0:
+                std::cout << " + 1.25 * 0.5";
+                break;
+            case 1:
+                std::cout << " - sin(0.75)";
+                break;
+            case 2:
+                std::cout << " + 3.125 / 2";
+                break;
+            default:
+                std::cout << " - (0.25 + 0.125)";
+            }
+        }
+        std::cout << "\n";
+        return 0;
+    }
+
+    double result { 0 };
+    size_t bytes { 0 };
+
+    // the string mode reads all of stdin up front, outside the timed region
+    std::string input;
+    if (mode == "string") {
+        pratt::fd_reader reader(STDIN_FILENO);
+        std::vector<char> buf(pratt::stream_lexer<token, conv, decltype(tokens), pratt::fd_reader>::default_chunk_size);
+        while (auto n = reader(buf.data(), buf.size())) {
+            input.append(buf.data(), n);
+        }
+    }
+
+    auto start = std::chrono::steady_clock::now();
+
+    if (mode == "string") {
+        bytes = input.size();
+        result = pratt::parser<nud, led, conv>(std::move(input), tokens, {}).parse(); // moved, the lexer owns its input
+    } else if (mode == "chunked") {
+        // callback reader counting the bytes pulled from stdin
+        auto reader = [&bytes, fd = pratt::fd_reader(STDIN_FILENO)](char* buf, size_t len) mutable {
+            auto n = fd(buf, len);
+            bytes += n;
+            return n;
+        };
+        using lexer = pratt::stream_lexer<token, conv, decltype(tokens), decltype(reader)>;
+        size_t chunk = argc > 2 ? std::stoul(argv[2]) : lexer::default_chunk_size;
+        result = pratt::parser<nud, led, conv, decltype(tokens), std::unordered_map<std::string, size_t>, lexer>(reader, tokens, {}, chunk).parse();
+    } else {
+        std::cerr << "unknown mode " << mode << "\n";
+        return 1;
+    }
+
+    auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto mb = static_cast<double>(bytes) / (1024 * 1024);
+    std::cout << mode << ": result " << result << ", " << mb << " MB in " << seconds << "s (" << mb / seconds << " MB/s), peak RSS " << peak_rss() << " MB\n";
+    return 0;
+}
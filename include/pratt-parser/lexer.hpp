@@ -3,6 +3,8 @@
 
 #include <ostream>
 #include <string_view>
+#include <tuple>
+#include <type_traits>
 #include <vector>
 
 #include "fast_float/fast_float.h"
@@ -10,6 +12,36 @@
 
 namespace pratt {
 
+namespace detail {
+    // converts a lexeme into a token (shared by the string and stream lexers)
+    template<typename TOKEN, typename CONV, typename MAP>
+    inline auto parse_token(std::string_view sv, MAP const& token_map, CONV const& conv) -> TOKEN
+    {
+        // check if we can match a known token name
+        if (auto it = token_map.find(sv); it != token_map.end()) {
+            return it->second;
+        }
+
+        // check if we can match a numeric value (parsed directly as float if that is the token value type, otherwise as double)
+        using number_t = std::conditional_t<std::is_same_v<typename TOKEN::value_t, float>, float, double>;
+        number_t result{0};
+        auto answer = fast_float::from_chars(sv.data(), sv.data() + sv.size(), result);
+        if(answer.ec == std::errc()) {
+            TOKEN tok{token_kind::constant};
+            tok = conv(result);
+            return tok;
+        }
+
+        // check if we can match a variable name (all chars are alphanumeric, the first char is a letter)
+        if (std::isalpha(sv.front()) && std::all_of(sv.begin(), sv.end(), [](auto c) { return std::isalnum(c) || is<'_'>(c); })) {
+            TOKEN t(token_kind::variable, std::string(sv.begin(), sv.end()));
+            return t;
+        }
+
+        return TOKEN(token_kind::eof);
+    }
+} // namespace detail
+
 template<typename TOKEN, typename CONV, typename MAP>
 class lexer {
 public:
@@ -20,16 +52,24 @@ public:
     {
     }
 
+    // the lexer keeps a reference to the token map, so it cannot be a temporary
+    lexer(std::string infix, MAP&& map) = delete;
+
+    // the peeked token is cached, so that peek followed by consume lexes it once
     inline auto peek() const -> TOKEN
     {
-        auto [t, _] = next();
-        return t;
+        if (!peeked_) {
+            std::tie(next_, next_pos_) = next();
+            peeked_ = true;
+        }
+        return next_;
     }
 
     inline void consume()
     {
-        auto [_, i] = next();
-        pos_ = i;
+        peek();
+        pos_ = next_pos_;
+        peeked_ = false;
     }
 
     [[nodiscard]] inline auto eof() const -> bool { return pos_ >= expr_.size(); }
@@ -49,6 +89,7 @@ public:
     inline void reset()
     {
         pos_ = 0;
+        peeked_ = false;
     }
 
 private:
@@ -80,33 +121,16 @@ private:
 
     inline auto parse(std::string_view sv) const -> TOKEN
     {
-        // check if we can match a known token name
-        if (auto it = token_map_.find(sv); it != token_map_.end()) {
-            return it->second;
-        }
-
-        // check if we can match a double value
-        double result{0};
-        auto answer = fast_float::from_chars(sv.data(), sv.data() + sv.size(), result);
-        if(answer.ec == std::errc()) {
-            TOKEN tok{token_kind::constant};
-            tok = conv_(result);
-            return tok;
-        }
-
-        // check if we can match a variable name (all chars are alphanumeric, the first char is a letter)
-        if (std::isalpha(sv.front()) && std::all_of(sv.begin(), sv.end(), [](auto c) { return std::isalnum(c) || is<'_'>(c); })) {
-            TOKEN t(token_kind::variable, std::string(sv.begin(), sv.end()));
-            return t;
-        }
-
-        return TOKEN(token_kind::eof);
+        return detail::parse_token<TOKEN>(sv, token_map_, conv_);
     }
 
-    MAP token_map_;
+    MAP const& token_map_; // not owned, must outlive the lexer
     CONV conv_;
     std::string expr_;
     size_t pos_;
+    mutable TOKEN next_;
+    mutable size_t next_pos_ { 0 };
+    mutable bool peeked_ { false };
 };
 } // namespace pratt
 #endif
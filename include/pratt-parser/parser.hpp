@@ -3,6 +3,9 @@
 
 #include <unordered_map>
 #include <optional>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
 
 #include "lexer.hpp"
 
@@ -10,30 +13,56 @@ namespace pratt {
 
 template <typename NUD, typename LED, typename CONV,
          typename TokenMap = std::unordered_map<std::string_view, typename NUD::token_t>,
-         typename VarMap = std::unordered_map<std::string, size_t>>
+         typename VarMap = std::unordered_map<std::string, size_t>,
+         typename Lexer = lexer<typename NUD::token_t, CONV, TokenMap>>
 class parser {
 public:
     using token_t = typename NUD::token_t;
     using value_t = typename token_t::value_t;
 
-    parser(std::string const& infix, TokenMap const& token_map, VarMap const& var_map)
-        : lexer_(infix, token_map)
+    // input is forwarded to the lexer (an infix string for pratt::lexer, a reader for pratt::stream_lexer),
+    // followed by any additional lexer arguments
+    template <typename Input, typename... Args>
+    parser(Input&& input, TokenMap const& token_map, VarMap const& var_map, Args&&... args)
+        : lexer_(std::forward<Input>(input), token_map, std::forward<Args>(args)...)
         , vars_(var_map)
     {
         static_assert(std::is_same_v<typename NUD::token_t, typename LED::token_t>, "The NUD and LED operations must use the same token type.");
     }
 
+    // the lexer keeps a reference to the token map, so it cannot be a temporary
+    template <typename Input, typename... Args>
+    parser(Input&& input, TokenMap&& token_map, VarMap const& var_map, Args&&... args) = delete;
+
+    // parse_bp recurses for every nested subexpression, so the nesting depth is bounded
+    // to keep untrusted input from overflowing the stack
+    static constexpr size_t default_max_depth = 1000;
+
     inline auto parse() -> value_t
     {
         return parse_bp(0).value();
     }
 
+    inline void set_max_depth(size_t max_depth) { max_depth_ = max_depth; }
+
     friend NUD;
     friend LED;
 
 private:
-    lexer<typename NUD::token_t, CONV, TokenMap> lexer_;
+    Lexer lexer_;
     VarMap vars_;
+    size_t depth_{0};
+    size_t max_depth_{default_max_depth};
+
+    struct depth_guard {
+        explicit depth_guard(size_t& depth) : depth_(++depth) { }
+        depth_guard(depth_guard const&) = delete;
+        depth_guard(depth_guard&&) = delete;
+        auto operator=(depth_guard const&) -> depth_guard& = delete;
+        auto operator=(depth_guard&&) -> depth_guard& = delete;
+        ~depth_guard() { --depth_; }
+        size_t& depth_;
+    };
 
     template<typename T = typename VarMap::mapped_type>
     inline auto get_desc(std::string const& name) const -> std::optional<T> {
@@ -49,17 +78,28 @@ private:
 
     inline auto parse_bp(int rbp = 0, token_kind end = token_kind::eof) -> token_t
     {
+        depth_guard guard(depth_);
+        if (depth_ > max_depth_) {
+            throw std::runtime_error("parser: maximum nesting depth " + std::to_string(max_depth_) + " exceeded");
+        }
+
         NUD nud;
-        LED led;
 
         auto left = lexer_.peek(); lexer_.consume();
         left.value() = nud(*this, left, left);
 
         if (left.kind() == token_kind::lparen) {
-            assert(lexer_.peek().kind() == token_kind::rparen);
-            lexer_.consume(); // eat rparen
+            expect_rparen();
         }
 
+        return parse_led(left, rbp, end);
+    }
+
+    // continues the expression from left with the operators that bind tighter than rbp
+    inline auto parse_led(token_t left, int rbp = 0, token_kind end = token_kind::eof) -> token_t
+    {
+        LED led;
+
         while(true) {
             auto next = lexer_.peek();
 
@@ -84,11 +124,25 @@ private:
 
             auto right = parse_bp(bp, end);
             auto op = next;
-            left = expr(led(*this, op, left, right));
+
+            // an LED that also accepts the current binding power and end token may look ahead and fuse operations
+            if constexpr (std::is_invocable_v<LED, parser&, token_t const&, token_t const&, token_t const&, int, token_kind>) {
+                left = expr(led(*this, op, left, right, rbp, end));
+            } else {
+                left = expr(led(*this, op, left, right));
+            }
         }
 
         return left;
-    };
+    }
+
+    inline void expect_rparen()
+    {
+        if (lexer_.peek().kind() != token_kind::rparen) {
+            throw std::runtime_error("parser: expected )");
+        }
+        lexer_.consume(); // eat rparen
+    }
 };
 } // namespace pratt
 
@@ -0,0 +1,183 @@
+#ifndef PRATT_STREAM_LEXER_HPP
+#define PRATT_STREAM_LEXER_HPP
+
+#include <cerrno>
+#include <cstring>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#endif
+
+#include "lexer.hpp"
+
+namespace pratt {
+
+// a reader is any callable with the signature size_t(char* buf, size_t len),
+// which fills buf with up to len bytes and returns how many were read (0 at end of input)
+
+class istream_reader {
+public:
+    explicit istream_reader(std::istream& is)
+        : is_(is)
+    {
+    }
+
+    inline auto operator()(char* buf, size_t len) -> size_t
+    {
+        is_.read(buf, static_cast<std::streamsize>(len));
+        return static_cast<size_t>(is_.gcount());
+    }
+
+private:
+    std::istream& is_;
+};
+
+#if defined(__unix__) || defined(__APPLE__)
+class fd_reader {
+public:
+    explicit fd_reader(int fd)
+        : fd_(fd)
+    {
+    }
+
+    inline auto operator()(char* buf, size_t len) -> size_t
+    {
+        while (true) {
+            auto n = ::read(fd_, buf, len);
+            if (n >= 0) {
+                return static_cast<size_t>(n);
+            }
+            if (errno != EINTR) {
+                throw std::runtime_error("fd_reader: " + std::string(std::strerror(errno)));
+            }
+        }
+    }
+
+private:
+    int fd_;
+};
+#endif
+
+// lexer pulling its input from a reader in fixed-size chunks, so that memory use
+// does not depend on the input size. a token must be shorter than the chunk size.
+template<typename TOKEN, typename CONV, typename MAP, typename READER>
+class stream_lexer {
+public:
+    static constexpr size_t default_chunk_size = 1U << 16U;
+
+    explicit stream_lexer(READER reader, MAP const& map, size_t chunk_size = default_chunk_size)
+        : token_map_(map)
+        , reader_(std::move(reader))
+        , buf_(chunk_size)
+    {
+    }
+
+    // the lexer keeps a reference to the token map, so it cannot be a temporary
+    stream_lexer(READER reader, MAP&& map, size_t chunk_size = default_chunk_size) = delete;
+
+    inline auto peek() const -> TOKEN
+    {
+        if (!peeked_) {
+            next_ = next();
+            peeked_ = true;
+        }
+        return next_;
+    }
+
+    inline void consume()
+    {
+        if (!peeked_) {
+            next();
+        }
+        peeked_ = false;
+    }
+
+    [[nodiscard]] inline auto eof() const -> bool { return peek().kind() == token_kind::eof; }
+
+    inline void expect(token_kind k) const { assert(peek().kind() == k); }
+
+    inline auto tokenize() -> std::vector<TOKEN>
+    {
+        std::vector<TOKEN> tokens;
+        do {
+            tokens.push_back(peek());
+            consume();
+        } while (tokens.back().kind() != token_kind::eof);
+        return tokens;
+    }
+
+private:
+    // moves the unconsumed bytes to the front of the buffer and reads the next chunk after them.
+    // returns false if no more input could be read.
+    inline auto fill() const -> bool
+    {
+        if (exhausted_) {
+            return false;
+        }
+        std::memmove(buf_.data(), buf_.data() + pos_, end_ - pos_);
+        end_ -= pos_;
+        pos_ = 0;
+        if (end_ == buf_.size()) {
+            throw std::runtime_error("stream_lexer: token exceeds chunk size " + std::to_string(buf_.size()));
+        }
+        auto n = reader_(buf_.data() + end_, buf_.size() - end_);
+        exhausted_ = n == 0;
+        end_ += n;
+        return n > 0;
+    }
+
+    // returns the next token and advances past it
+    inline auto next() const -> TOKEN
+    {
+        while (true) {
+            while (pos_ < end_ && std::isspace(buf_[pos_])) {
+                ++pos_;
+            }
+            if (pos_ < end_) {
+                break;
+            }
+            if (!fill()) {
+                return TOKEN(token_kind::eof);
+            }
+        }
+
+        if (is<lp, rp>(buf_[pos_])) {
+            ++pos_;
+            return detail::parse_token<TOKEN>(std::string_view(buf_.data() + pos_ - 1, 1), token_map_, conv_);
+        }
+
+        // the token may straddle the chunk boundary, in which case the buffer is refilled
+        // (fill keeps the token prefix) and the scan resumes where it stopped
+        auto len = size_t{1};
+        while (true) {
+            while (pos_ + len < end_ && !(std::isspace(buf_[pos_ + len]) || is<lp, rp>(buf_[pos_ + len]))) {
+                ++len;
+            }
+            if (pos_ + len < end_ || !fill()) {
+                break;
+            }
+        }
+
+        auto tok = detail::parse_token<TOKEN>(std::string_view(buf_.data() + pos_, len), token_map_, conv_);
+        pos_ += len;
+        return tok;
+    }
+
+    MAP const& token_map_; // not owned, must outlive the lexer
+    CONV conv_;
+    mutable READER reader_;
+    mutable std::vector<char> buf_;
+    mutable size_t pos_ { 0 };
+    mutable size_t end_ { 0 };
+    mutable bool exhausted_ { false };
+    // the peeked token is valid while peeked_ is set (a plain member rather than std::optional,
+    // which trips -Wmaybe-uninitialized in gcc at -O2 and above)
+    mutable TOKEN next_;
+    mutable bool peeked_ { false };
+};
+} // namespace pratt
+#endif
@@ -1,10 +1,18 @@
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
 #include "doctest/doctest.h"
 #include <string>
+#include <array>
+#include <cstring>
 #include <functional>
+#include <sstream>
 
+#include "pratt-parser/stream_lexer.hpp"
 #include "../example/calculator.hpp"
 
+#if defined(__unix__) || defined(__APPLE__)
+#include "../example/daemon.hpp"
+#endif
+
 namespace pratt::test {
 
 using token = pratt::token<double>;
@@ -12,26 +20,14 @@ using nud = pratt::calculator::nud;
 using led = pratt::calculator::led;
 using conv = pratt::calculator::identity;
 
-using pratt::calculator::operations;
-using pratt::associativity;
-
-const std::unordered_map<std::string_view, token> tokens {
-    { "+", token(pratt::token_kind::dynamic, "+", operations::add, 10, associativity::left) },
-    { "-", token(pratt::token_kind::dynamic, "-", operations::sub, 10, associativity::left) },
-    { "*", token(pratt::token_kind::dynamic, "*", operations::mul, 20, associativity::left) },
-    { "/", token(pratt::token_kind::dynamic, "/", operations::div, 20, associativity::left) },
-    { "^", token(pratt::token_kind::dynamic, "^", operations::pow, 30, associativity::right) },
-    { "exp", token(pratt::token_kind::dynamic, "exp", operations::exp, 30, associativity::none) },
-    { "log", token(pratt::token_kind::dynamic, "log", operations::log, 30, associativity::none) },
-    { "sin", token(pratt::token_kind::dynamic, "sin", operations::sin, 30, associativity::none) },
-    { "cos", token(pratt::token_kind::dynamic, "cos", operations::cos, 30, associativity::none) },
-    { "tan", token(pratt::token_kind::dynamic, "tan", operations::tan, 30, associativity::none) },
-    { "sqrt", token(pratt::token_kind::dynamic, "sqrt", operations::sqrt, 30, associativity::none) },
-    { "square", token(pratt::token_kind::dynamic, "square", operations::square, 30, associativity::right) },
-    { "(", token(pratt::token_kind::lparen, "(", operations::noop, 0, associativity::none) },
-    { ")", token(pratt::token_kind::rparen, "(", operations::noop, 0, associativity::none) },
-    { "eof", token(pratt::token_kind::eof, "eof", operations::noop, 0, associativity::none) }
-};
+auto const tokens = pratt::calculator::make_tokens();
+
+// the lexer references the token map, so a temporary map must not compile
+using map_t = std::unordered_map<std::string_view, token>;
+using var_map_t = std::unordered_map<std::string, size_t>;
+static_assert(std::is_constructible_v<pratt::parser<nud, led, conv>, std::string, map_t const&, var_map_t>);
+static_assert(!std::is_constructible_v<pratt::parser<nud, led, conv>, std::string, map_t, var_map_t>);
+static_assert(!std::is_constructible_v<pratt::lexer<token, conv, map_t>, std::string, map_t>);
 
 auto eval(std::string const& infix) -> double {
     return pratt::parser<nud, led, conv>(infix, tokens, {}).parse();
@@ -114,6 +110,231 @@ TEST_CASE("Parser")
     CHECK_SUBCASE("exp(tan(5))",         std::exp(std::tan(5)));
     CHECK_SUBCASE("square(exp(tan(5)))", std::pow(std::exp(std::tan(5)), 2));
     CHECK_SUBCASE("cos(5) * sin(6)",     std::cos(5) * std::sin(6));
+    CHECK_SUBCASE("3 ^ 2",               9);
+    CHECK_SUBCASE("(1 + 2) ^ 2 * 2",     18);
+    CHECK_SUBCASE("exp - 2",             std::exp(-2));
+    CHECK_SUBCASE("exp - 2 * 3 + 1",     std::exp(-6) + 1);
+    CHECK_SUBCASE("exp(-2)",             std::exp(-2));
+    CHECK_SUBCASE("exp(- 2 * 3) + 1",    std::exp(-6) + 1);
+    CHECK_SUBCASE("exp(-2 + 3) * 2",     std::exp(1) * 2);
+    CHECK_SUBCASE("exp(-(2 + 3))",       std::exp(-5));
+    CHECK_SUBCASE("exp(2 - 3)",          std::exp(-1));
+    CHECK_SUBCASE("exp((-2))",           std::exp(-2));
+}
+
+TEST_CASE("Parser (malformed input)")
+{
+    SUBCASE("unbalanced parenthesis")
+    {
+        CHECK_THROWS_WITH(eval("(1"), "parser: expected )");
+        CHECK_THROWS_WITH(eval("(1 + (2 * 3)"), "parser: expected )");
+        CHECK_THROWS_WITH(eval("exp(-2"), "parser: expected )");
+        CHECK_THROWS_WITH(eval("exp(2"), "parser: expected )");
+    }
+
+    SUBCASE("nesting depth")
+    {
+        CHECK_THROWS_WITH(eval(std::string(2000000, '(') + "1"), "parser: maximum nesting depth 1000 exceeded");
+
+        // the lexer splits on whitespace, so the unary minus chain needs separators
+        std::string minus;
+        for (int i = 0; i < 2000000; ++i) { // NOLINT
+            minus += "- ";
+        }
+        CHECK_THROWS_WITH(eval(minus + "1"), "parser: maximum nesting depth 1000 exceeded");
+
+        auto nested = std::string(100, '(') + "1" + std::string(100, ')');
+        CHECK_EQ(eval(nested), 1);
+
+        pratt::parser<nud, led, conv> p(nested, tokens, {});
+        p.set_max_depth(50);
+        CHECK_THROWS_WITH(p.parse(), "parser: maximum nesting depth 50 exceeded");
+    }
+}
+
+TEST_CASE("Parser (fused)")
+{
+    using fused_led = pratt::calculator::fused_led;
+
+    auto eval_fused = [](std::string const& infix) {
+        return pratt::parser<nud, fused_led, conv, decltype(tokens)>(infix, tokens, {}).parse();
+    };
+
+    CHECK_EQ(eval_fused("2 * 3 + 1"),             7);
+    CHECK_EQ(eval_fused("2 * 3 ^ 2 + 1"),         19);
+    CHECK_EQ(eval_fused("1 - 2 * 3 + 4"),         -1);
+    CHECK_EQ(eval_fused("2 * 3 - 4 * 5 + 6"),     -8);
+    CHECK_EQ(eval_fused("-(2 * 3) + 1"),          -5);
+    CHECK_EQ(eval_fused("- 2 * 3 + 1"),           eval("- 2 * 3 + 1"));
+    CHECK_EQ(eval_fused("(2 * 3 + 1) * 2"),       14);
+    CHECK_EQ(eval_fused("exp - 2 * 3 + 1"),       std::exp(-6) + 1);
+    CHECK_EQ(eval_fused("exp(-2 * 3) + 1"),       std::exp(-6) + 1);
+    // a single rounding for the fused product and sum
+    CHECK_EQ(eval_fused("0.1 * 10 - 1"),          std::fma(0.1, 10, -1));
+}
+
+TEST_CASE("Parser (float)")
+{
+    using token_f = pratt::token<float>;
+    using pratt::calculator::basic_led;
+    using pratt::calculator::basic_nud;
+
+    auto const tokens_f = pratt::calculator::make_tokens<token_f>();
+
+    auto eval_float = [&](std::string const& infix) {
+        return pratt::parser<basic_nud<float>, basic_led<float>, conv, decltype(tokens_f)>(infix, tokens_f, {}).parse();
+    };
+    // the mixed grammar carries a double accumulator, so it uses the double token map
+    auto eval_mixed = [&](std::string const& infix) {
+        return pratt::parser<basic_nud<float, double>, basic_led<float, double>, conv, decltype(tokens)>(infix, tokens, {}).parse();
+    };
+
+    CHECK_EQ(eval_float("1 + 2 * 3"), 7.0F);
+    CHECK_EQ(eval_float("0.1"), 0.1F);
+    CHECK_EQ(eval_float("exp(2)"), std::exp(2.0F));
+    CHECK_EQ(eval_mixed("1 + 2 * 3"), 7.0);
+    CHECK_EQ(eval_mixed("exp(2)"), std::exp(2.0));
+    // literals are stored as float
+    CHECK_EQ(eval_mixed("0.1"), static_cast<double>(0.1F));
+    // intermediates are not rounded to float: 2^24 + 1 is not representable as float
+    CHECK_EQ(eval_float("16777216 + 1 - 16777216"), 0.0F);
+    CHECK_EQ(eval_mixed("16777216 + 1 - 16777216"), 1.0);
+}
+
+TEST_CASE("Stream lexer")
+{
+    using reader = pratt::istream_reader;
+    using stream_lexer = pratt::stream_lexer<token, conv, decltype(tokens), reader>;
+
+    // small chunks so that tokens and numeric literals straddle chunk boundaries
+    // (a token must be shorter than a chunk, and the longest name is square)
+    constexpr size_t chunk_size = 7;
+
+    auto tokenize = [&](std::string const& infix) {
+        std::istringstream is(infix);
+        return stream_lexer(reader(is), tokens, chunk_size).tokenize();
+    };
+
+    auto eval_stream = [&](std::string const& infix) {
+        std::istringstream is(infix);
+        return pratt::parser<nud, led, conv, decltype(tokens), std::unordered_map<std::string, size_t>, stream_lexer>(reader(is), tokens, {}, chunk_size).parse();
+    };
+
+    SUBCASE("tokens match the string lexer")
+    {
+        std::string infix("1.25 + exp(2.5) *   sqrt(3.75)  ");
+        pratt::lexer<token, conv, decltype(tokens)> lex(infix, tokens);
+        auto expected = lex.tokenize();
+        auto actual = tokenize(infix);
+        REQUIRE(actual.size() == expected.size());
+        for (size_t i = 0; i < actual.size(); ++i) {
+            CHECK(actual[i].kind() == expected[i].kind());
+            CHECK(actual[i].to_string() == expected[i].to_string());
+        }
+    }
+
+    SUBCASE("token longer than the chunk size")
+    {
+        CHECK_THROWS(tokenize("1 + 123456789"));
+    }
+
+    SUBCASE("parser")
+    {
+        CHECK_EQ(eval_stream("(1 + 2) * (3 + 4)"), 21);
+        CHECK_EQ(eval_stream("1.25 * 1.25 + 2 ^ 3 ^ 2"), 1.5625 + 512);
+        CHECK_EQ(eval_stream("square(exp(tan(5)))"), std::pow(std::exp(std::tan(5)), 2));
+
+        // many chunk refills, with literals and names cut at every offset
+        std::string infix("1.5");
+        for (int i = 0; i < 100; ++i) { // NOLINT
+            infix += " + 1.25 * sin(0.75) - 3.125 / (2 + 0.5)";
+        }
+        CHECK_EQ(eval_stream(infix), eval(infix));
+    }
+}
+
+#if defined(__unix__) || defined(__APPLE__)
+TEST_CASE("Daemon")
+{
+    using pratt::daemon::frame;
+
+    std::array<int, 2> fds {};
+    REQUIRE(::socketpair(AF_UNIX, SOCK_STREAM, 0, fds.data()) == 0);
+
+    auto write_header = [&](uint32_t size) {
+        std::array<char, pratt::daemon::header_size> header {};
+        std::memcpy(header.data(), &size, sizeof(size));
+        return pratt::daemon::write_all(fds[0], header.data(), header.size());
+    };
+
+    SUBCASE("frame round trip")
+    {
+        frame req { 42, static_cast<uint8_t>(pratt::daemon::op::parse), "1 + 2" };
+        REQUIRE(pratt::daemon::write_frame(fds[0], req));
+        REQUIRE(pratt::daemon::write_frame(fds[0], frame { 7, 0, {} }));
+
+        frame res;
+        REQUIRE(pratt::daemon::read_frame(fds[1], res));
+        CHECK(res.id == 42);
+        CHECK(res.code == static_cast<uint8_t>(pratt::daemon::op::parse));
+        CHECK(res.payload == "1 + 2");
+
+        REQUIRE(pratt::daemon::read_frame(fds[1], res));
+        CHECK(res.id == 7);
+        CHECK(res.payload.empty());
+    }
+
+    SUBCASE("frame smaller than the header")
+    {
+        REQUIRE(write_header(pratt::daemon::header_size - 1));
+        frame res;
+        CHECK_FALSE(pratt::daemon::read_frame(fds[1], res));
+    }
+
+    SUBCASE("frame larger than the maximum size")
+    {
+        REQUIRE(write_header(pratt::daemon::max_frame_size + 1));
+        frame res;
+        CHECK_FALSE(pratt::daemon::read_frame(fds[1], res));
+    }
+
+    SUBCASE("closed connection")
+    {
+        ::close(fds[0]);
+        fds[0] = -1;
+        frame res;
+        CHECK_FALSE(pratt::daemon::read_frame(fds[1], res));
+    }
+
+    for (auto fd : fds) {
+        if (fd >= 0) {
+            ::close(fd);
+        }
+    }
+}
+
+TEST_CASE("Histogram")
+{
+    pratt::daemon::histogram h;
+    CHECK(h.quantile(0.5) == 0); // NOLINT
+
+    // buckets are [0, 1), [1, 2), [2, 4), [4, 8), ...
+    for (uint64_t v : { 0, 1, 2, 3 }) {
+        h.record(v);
+    }
+    CHECK(h.count() == 4);
+    CHECK(h.quantile(0.0) == 1);
+    CHECK(h.quantile(0.25) == 2); // NOLINT
+    CHECK(h.quantile(0.5) == 4);  // NOLINT
+    CHECK(h.quantile(0.99) == 4); // NOLINT
+
+    h.record(4);
+    CHECK(h.quantile(1.0) == 8);
+
+    // values past the last bucket are clamped into it
+    h.record(uint64_t { 1 } << 40U);
+    CHECK(h.quantile(1.0) == uint64_t { 1 } << (pratt::daemon::histogram::bucket_count - 1));
 }
+#endif
 
 } // namespace